@@ -0,0 +1,326 @@
+// Micro-benchmarks for the simulator components.
+//
+// Usage: memsim_bench [--out FILE] [--baseline FILE] [--threshold F] [--update-baseline]
+//
+// Every benchmark replays a pre-generated, fixed-seed trace so runs are
+// comparable; the median of several time-bounded repetitions, interleaved
+// across cases, is reported as ns/op. Results are written as JSON and
+// compared against the baseline after normalising for host speed: any entry
+// slower than baseline * (1 + threshold), and still slower when re-measured,
+// is reported and the exit status is 1. A missing or unreadable baseline is
+// an error (exit 2) unless --update-baseline is given. Baselines are only
+// meaningful on the host that recorded them; make bench keeps one per host.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../src/allocator/allocator.h"
+#include "../src/buddy/buddy.h"
+#include "../src/cache/cache.h"
+#include "../src/virtual_memory/virtual_memory.h"
+
+namespace {
+
+struct Result { std::string name; double nsPerOp; };
+
+// One benchmark: body() replays its trace once and returns the op count.
+struct Case { std::string name; std::function<size_t()> body; };
+
+const int kRepetitions = 11;
+const double kMinRepetitionNs = 20e6; // each repetition replays the trace for at least 20ms
+const int kConfirmRuns = 2; // re-measurements a suspected regression must survive
+const unsigned kSeed = 12345;
+volatile size_t sink = 0; // keeps results observable so loops are not elided
+
+using Clock = std::chrono::steady_clock;
+
+// Times one repetition: replays the trace until kMinRepetitionNs has
+// elapsed, so short traces are not dominated by timer resolution.
+double timeRepetition(const Case &c) {
+    size_t ops = 0;
+    double elapsed = 0;
+    auto t0 = Clock::now();
+    do {
+        ops += c.body();
+        elapsed = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    } while (elapsed < kMinRepetitionNs);
+    return elapsed / (ops ? ops : 1);
+}
+
+// Runs the repetitions round-robin across all cases and reports the median
+// ns/op of each, so a burst of machine noise costs every case at most one
+// sample instead of skewing a few cases entirely.
+std::vector<Result> runCases(const std::vector<Case> &cases) {
+    std::vector<std::vector<double>> samples(cases.size());
+    for (int r = 0; r < kRepetitions; ++r)
+        for (size_t i = 0; i < cases.size(); ++i) samples[i].push_back(timeRepetition(cases[i]));
+    std::vector<Result> out;
+    for (size_t i = 0; i < cases.size(); ++i) {
+        auto &v = samples[i];
+        std::sort(v.begin(), v.end());
+        out.push_back({cases[i].name, v[v.size() / 2]});
+    }
+    return out;
+}
+
+// Alloc/free trace: size > 0 is an allocation, size == 0 frees the live
+// block selected by pick % live.size().
+struct AllocOp { size_t size; size_t pick; };
+
+std::vector<AllocOp> makeAllocTrace(size_t heap, size_t ops) {
+    std::mt19937 rng(kSeed);
+    size_t maxReq = heap / 64 > 16 ? heap / 64 : 16;
+    std::uniform_int_distribution<size_t> sz(1, maxReq);
+    std::vector<AllocOp> t; t.reserve(ops);
+    for (size_t i = 0; i < ops; ++i) {
+        if (rng() % 2) t.push_back({sz(rng), 0});
+        else t.push_back({0, rng()});
+    }
+    return t;
+}
+
+template <typename A>
+size_t replayAlloc(A &a, const std::vector<AllocOp> &trace) {
+    std::vector<int> live; live.reserve(trace.size());
+    size_t ops = 0;
+    for (const auto &op : trace) {
+        if (op.size) {
+            int id = a.allocate(op.size);
+            if (id != -1) live.push_back(id);
+            ++ops;
+        } else if (!live.empty()) {
+            size_t i = op.pick % live.size();
+            sink = sink + a.freeBlockById(live[i]);
+            live[i] = live.back(); live.pop_back();
+            ++ops;
+        }
+    }
+    sink = sink + live.size();
+    return ops;
+}
+
+std::vector<size_t> makeAddrTrace(size_t span, size_t ops) {
+    std::mt19937 rng(kSeed);
+    std::uniform_int_distribution<size_t> addr(0, span - 1);
+    std::vector<size_t> t; t.reserve(ops);
+    for (size_t i = 0; i < ops; ++i) t.push_back(addr(rng));
+    return t;
+}
+
+std::string key(const std::string &base, size_t a, const char *an, size_t b, const char *bn) {
+    std::ostringstream os;
+    os << base << "/" << an << "=" << a << "/" << bn << "=" << b;
+    return os.str();
+}
+
+void benchAllocator(std::vector<Case> &out) {
+    const char *strategies[] = {"first_fit", "best_fit", "worst_fit"};
+    for (size_t heap : {size_t(4096), size_t(65536), size_t(1) << 20}) {
+        for (size_t ops : {size_t(1024), size_t(16384)}) {
+            auto trace = makeAllocTrace(heap, ops);
+            for (const char *s : strategies) {
+                out.push_back({key(std::string("allocator/") + s, heap, "heap", ops, "ops"), [=] {
+                    Allocator a; a.init(heap); a.setStrategy(s);
+                    return replayAlloc(a, trace);
+                }});
+            }
+            out.push_back({key("buddy", heap, "heap", ops, "ops"), [=] {
+                BuddyAllocator b; b.init(heap);
+                return replayAlloc(b, trace);
+            }});
+        }
+    }
+}
+
+void benchCache(std::vector<Case> &out) {
+    const size_t cacheSize = 32768, blockSize = 64;
+    for (size_t ops : {size_t(4096), size_t(65536)}) {
+        // working set of 4x the cache gives a mix of hits and misses
+        auto trace = makeAddrTrace(cacheSize * 4, ops);
+        for (size_t assoc : {size_t(1), size_t(4), size_t(16)}) {
+            for (Replacement r : {Replacement::FIFO, Replacement::LRU}) {
+                std::string base = std::string("cache/") + (r == Replacement::LRU ? "lru" : "fifo");
+                out.push_back({key(base, assoc, "assoc", ops, "ops"), [=] {
+                    CacheLevel c; c.init(cacheSize, blockSize, assoc, r);
+                    for (size_t addr : trace) sink = sink + c.access(addr);
+                    return trace.size();
+                }});
+            }
+        }
+    }
+}
+
+void benchVirtualMemory(std::vector<Case> &out) {
+    const size_t pageSize = 4096, virtSize = size_t(1) << 30;
+    for (size_t frames : {size_t(64), size_t(1024)}) {
+        size_t phys = frames * pageSize;
+        for (size_t ops : {size_t(4096), size_t(65536)}) {
+            // hit-heavy: the working set fits in physical memory
+            auto hot = makeAddrTrace(phys / 2, ops);
+            // fault-heavy: the working set is 8x physical memory
+            auto cold = makeAddrTrace(phys * 8, ops);
+            struct { const char *name; std::vector<size_t> trace; } cases[] = {
+                {"vm/hit_heavy", hot}, {"vm/fault_heavy", cold}};
+            for (auto &c : cases) {
+                std::vector<size_t> trace = c.trace;
+                out.push_back({key(c.name, frames, "frames", ops, "ops"), [=] {
+                    VirtualMemory vm; vm.init(virtSize, pageSize, phys);
+                    for (size_t addr : trace) sink = sink + vm.translate(addr);
+                    return trace.size();
+                }});
+            }
+        }
+    }
+}
+
+// Fixed CPU/memory loop that does not touch simulator code. Its ns/op tracks
+// the speed of the host, and the comparison uses it to cancel out machine-wide
+// drift (frequency scaling, noisy neighbours) between baseline and run.
+const char *kCalibration = "calibration/host";
+
+void benchCalibration(std::vector<Case> &out) {
+    out.push_back({kCalibration, [] {
+        std::vector<size_t> next(16384);
+        for (size_t i = 0; i < next.size(); ++i) next[i] = (i * 7919 + 1) % next.size();
+        size_t p = 0, acc = 0;
+        for (size_t i = 0; i < 65536; ++i) { p = next[p]; acc += p ^ i; }
+        sink = sink + acc;
+        return size_t(65536);
+    }});
+}
+
+void writeJson(std::ostream &os, const std::vector<Result> &results) {
+    os << "{\n  \"unit\": \"ns_per_op\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "%.3f", results[i].nsPerOp);
+        os << "    {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << buf << "}"
+           << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+// Reads back the format produced by writeJson; not a general JSON parser.
+// Returns false if the file is missing, a value is malformed or the
+// calibration entry is absent.
+bool readJson(const std::string &path, std::map<std::string, double> &out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t n = line.find("\"name\": \"");
+        size_t v = line.find("\"ns_per_op\": ");
+        if (n == std::string::npos || v == std::string::npos) continue;
+        n += 9;
+        size_t end = line.find('"', n);
+        if (end == std::string::npos) continue;
+        try { out[line.substr(n, end - n)] = std::stod(line.substr(v + 13)); }
+        catch (const std::exception &) { return false; }
+    }
+    // an empty or truncated file, or one without the calibration entry
+    // needed for scaling, is as unusable as a missing one
+    return out.count(kCalibration) > 0;
+}
+
+const char *kUsage =
+    "Usage: memsim_bench [--out FILE] [--baseline FILE] [--threshold F] [--update-baseline]\n";
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string outPath = "bench/results.json";
+    std::string baselinePath = "bench/baseline.json";
+    double threshold = 0.25;
+    bool updateBaseline = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) outPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) baselinePath = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) {
+            try { threshold = std::stod(argv[++i]); }
+            catch (const std::exception &) { threshold = -1; }
+            if (threshold < 0) { std::cerr << "Invalid threshold: " << argv[i] << "\n" << kUsage; return 2; }
+        }
+        else if (arg == "--update-baseline") updateBaseline = true;
+        else { std::cerr << kUsage; return 2; }
+    }
+    if (outPath == baselinePath) {
+        std::cerr << "--out and --baseline must be different files\n" << kUsage;
+        return 2;
+    }
+    std::map<std::string, double> baseline;
+    if (!updateBaseline && !readJson(baselinePath, baseline)) {
+        std::cerr << "No readable baseline at " << baselinePath << "; record one with make bench-baseline\n";
+        return 2;
+    }
+
+    std::vector<Case> cases;
+    benchCalibration(cases);
+    benchAllocator(cases);
+    benchCache(cases);
+    benchVirtualMemory(cases);
+    std::vector<Result> results = runCases(cases);
+
+    for (const auto &r : results) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%10.1f", r.nsPerOp);
+        std::cout << buf << " ns/op  " << r.name << "\n";
+    }
+
+    std::ofstream out(outPath);
+    if (!out) { std::cerr << "Cannot write " << outPath << "\n"; return 2; }
+    writeJson(out, results);
+    std::cout << "Results written to " << outPath << "\n";
+
+    if (updateBaseline) {
+        std::ofstream base(baselinePath);
+        if (!base) { std::cerr << "Cannot write " << baselinePath << "\n"; return 2; }
+        writeJson(base, results);
+        std::cout << "Baseline updated: " << baselinePath << "\n";
+        return 0;
+    }
+
+    // scale results to the baseline host speed before comparing
+    auto cal = baseline.find(kCalibration);
+    double baseCal = cal != baseline.end() ? cal->second : 0;
+    auto scaleFor = [baseCal](double calNs) { return baseCal > 0 && calNs > 0 ? baseCal / calNs : 1.0; };
+    double scale = scaleFor(results[0].nsPerOp);
+    std::printf("Host speed vs baseline: %.2fx (results scaled by %.3f)\n", scale, scale);
+
+    int regressions = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        if (r.name == kCalibration) continue;
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0) {
+            std::cout << "NEW " << r.name << " (not in baseline)\n";
+            continue;
+        }
+        double ratio = r.nsPerOp * scale / it->second;
+        if (ratio <= 1.0 + threshold) continue;
+        // a real slowdown reproduces, a burst of host noise does not
+        for (int retry = 0; retry < kConfirmRuns && ratio > 1.0 + threshold; ++retry) {
+            std::vector<Result> again = runCases({cases[0], cases[i]});
+            ratio = std::min(ratio, again[1].nsPerOp * scaleFor(again[0].nsPerOp) / it->second);
+        }
+        if (ratio <= 1.0 + threshold) {
+            std::cout << "noise " << r.name << " (not reproduced)\n";
+            continue;
+        }
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "REGRESSION %s: %.1f -> %.1f ns/op (+%.0f%%)",
+                      r.name.c_str(), it->second, it->second * ratio, (ratio - 1.0) * 100.0);
+        std::cout << buf << "\n";
+        ++regressions;
+    }
+    std::cout << regressions << " regression(s) beyond " << threshold * 100.0 << "% threshold\n";
+    return regressions ? 1 : 0;
+}
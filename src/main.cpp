@@ -9,6 +9,18 @@
 #include "cache/cache.h"
 #include "virtual_memory/virtual_memory.h"
 
+// Parses a decimal or 0x-prefixed number; false on garbage instead of throwing.
+static bool parseNumber(const std::string &token, size_t &out) {
+    if (token.empty() || token[0] == '-') return false;
+    try {
+        size_t used = 0;
+        out = std::stoul(token, &used, 0);
+        return used == token.size();
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
 int main() {
     Allocator alloc;
     PhysicalMemory pm;
@@ -137,7 +149,10 @@ int main() {
             }
         } else if (cmd == "vm") {
             std::string subcmd; iss >> subcmd;
-            if (subcmd == "init") {
+            bool needsProcess = subcmd == "access" || subcmd == "write" || subcmd == "fork" || subcmd == "share";
+            if (needsProcess && vm.isInitialized() && !vm.hasProcess(vm.currentPid())) {
+                std::cout << "No current process (use vm switch <pid>)\n";
+            } else if (subcmd == "init") {
                 size_t vs, ps, ph; iss >> vs >> ps >> ph;
                 vm.init(vs, ps, ph);
                 std::cout << "VM initialized: virt=" << vs << " page=" << ps << " phys=" << ph << "\n";
@@ -147,6 +162,43 @@ int main() {
                 size_t phys = vm.translate(addr);
                 if (phys) std::cout << "VM: vaddr=" << token << " -> paddr=" << phys << "\n";
                 else std::cout << "VM page fault\n";
+            } else if (subcmd == "write") {
+                std::string token; iss >> token;
+                size_t addr = 0, phys = 0;
+                if (!parseNumber(token, addr)) std::cout << "Usage: vm write <addr>\n";
+                else if (vm.translate(addr, true, phys)) std::cout << "VM: write vaddr=" << token << " -> paddr=" << phys << "\n";
+                else std::cout << "VM page fault\n";
+            } else if (subcmd == "fork") {
+                int parent = vm.currentPid();
+                int child = vm.fork();
+                if (child != -1) std::cout << "Forked pid=" << parent << " -> child pid=" << child << " asid=" << vm.asidOf(child) << "\n";
+                else std::cout << "Fork failed\n";
+            } else if (subcmd == "switch") {
+                int pid = -1; iss >> pid;
+                if (vm.switchTo(pid)) std::cout << "Switched to pid=" << pid << " asid=" << vm.asidOf(pid) << "\n";
+                else std::cout << "No such process\n";
+            } else if (subcmd == "share") {
+                int src = -1; std::string saddr, daddr; iss >> src >> saddr >> daddr;
+                size_t sa = 0, da = 0;
+                if (!iss || !parseNumber(saddr, sa) || !parseNumber(daddr, da)) { std::cout << "Usage: vm share <src_pid> <src_addr> <dst_addr>\n"; }
+                else if (vm.share(src, sa, da))
+                    std::cout << "Shared pid=" << src << " " << saddr << " -> pid=" << vm.currentPid() << " " << daddr << "\n";
+                else std::cout << "Share failed\n";
+            } else if (subcmd == "exit") {
+                int pid = -1; iss >> pid;
+                if (vm.exitProcess(pid)) std::cout << "Process " << pid << " exited\n";
+                else std::cout << "No such process\n";
+            } else if (subcmd == "tlb") {
+                std::string count, mode; iss >> count >> mode;
+                size_t entries = 0;
+                if (!parseNumber(count, entries) || (mode != "flush" && mode != "asid")) {
+                    std::cout << "Usage: vm tlb <entries> <flush|asid>\n";
+                } else {
+                    vm.setTlb(entries, mode == "flush" ? TlbMode::FLUSH : TlbMode::ASID);
+                    std::cout << "TLB: entries=" << entries << " mode=" << mode << "\n";
+                }
+            } else if (subcmd == "ps") {
+                vm.ps();
             } else if (subcmd == "stats") {
                 vm.stats();
             }
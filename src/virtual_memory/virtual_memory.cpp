@@ -1,47 +1,269 @@
 #include "virtual_memory.h"
+#include <algorithm>
 #include <iostream>
 
 VirtualMemory::VirtualMemory() {}
 
 void VirtualMemory::init(size_t virt_size, size_t page_size, size_t phys_size) {
     virtSize = virt_size; pageSize = page_size; physSize = phys_size;
-    numPages = virtSize / pageSize; numFrames = physSize / pageSize;
-    pt.clear(); pageFaults = 0; pageHits = 0; nextFrame = 0;
+    numPages = pageSize ? virtSize / pageSize : 0;
+    numFrames = pageSize ? physSize / pageSize : 0;
+    pageFaults = 0; pageHits = 0; nextFrame = 0; accessCounter = 0;
+    evictions = cowFaults = cowCopies = 0;
+    frames.assign(numFrames, Frame{});
+    freeFrames.clear();
+    procs.clear();
+    procs[0] = Process{0, {}};
+    current = 0; nextPid = 1; nextAsid = 1;
+    tlb.clear();
+    tlbSize = 16; tlbMode = TlbMode::ASID;
+    tlbHits = tlbMisses = tlbFlushes = contextSwitches = 0;
 }
 
-size_t VirtualMemory::translate(size_t vaddr) {
-    if (!isInitialized()) return 0;  // Return 0 if not initialized
-    
+size_t VirtualMemory::translate(size_t vaddr, bool write) {
+    size_t paddr = 0;
+    translate(vaddr, write, paddr);
+    return paddr;
+}
+
+bool VirtualMemory::translate(size_t vaddr, bool write, size_t &paddr) {
+    if (!isInitialized()) return false;
+    if (numFrames == 0) return false;
+    auto pit = procs.find(current);
+    if (pit == procs.end()) return false;
+    Process &p = pit->second;
+
     size_t vpn = vaddr / pageSize; size_t offset = vaddr % pageSize;
     accessCounter++;
-    auto it = pt.find(vpn);
-    if (it == pt.end() || !it->second.valid) {
-        // page fault
-        pageFaults++;
-        if (nextFrame >= numFrames) {
-            // evict LRU
-            if (pt.empty()) return 0;
-            size_t victimVpn = 0; size_t minAccess = (size_t)-1;
-            for (auto &p : pt) {
-                if (p.second.valid && p.second.lastAccess < minAccess) {
-                    minAccess = p.second.lastAccess; victimVpn = p.first;
-                }
-            }
-            size_t victimFrame = pt[victimVpn].frame;
-            pt.erase(victimVpn);
-            pt[vpn] = {true, victimFrame, accessCounter};
-            return victimFrame * pageSize + offset;
-        } else {
-            pt[vpn] = {true, nextFrame++, accessCounter};
-            return pt[vpn].frame * pageSize + offset;
+
+    if (TlbEntry *e = tlbLookup(p.asid, vpn)) {
+        if (!write || e->writable) {
+            tlbHits++; pageHits++; p.hits++;
+            e->lastUse = accessCounter;
+            frames[e->frame].lastAccess = accessCounter;
+            paddr = e->frame * pageSize + offset;
+            return true;
         }
+        // write through a read-only (COW) translation: take the slow path
+        tlbInvalidate(p.asid, vpn);
+    }
+    // with the TLB disabled every translation is a page walk
+    tlbMisses++;
+
+    auto it = p.pt.find(vpn);
+    if (it == p.pt.end()) {
+        // page fault; evicts the globally least recently used frame when full
+        pageFaults++; p.faults++;
+        size_t f = allocFrame();
+        mapFrame(current, vpn, f, false, false);
+    } else if (write && it->second.cow) {
+        // copy-on-write fault
+        pageFaults++; p.faults++;
+        if (breakCow(current, vpn)) { p.cowFaults++; cowFaults++; }
     } else {
-        pageHits++;
-        it->second.lastAccess = accessCounter;
-        return it->second.frame * pageSize + offset;
+        pageHits++; p.hits++;
+    }
+    PageTableEntry &pte = p.pt[vpn];
+    frames[pte.frame].lastAccess = accessCounter;
+    tlbInsert(p.asid, vpn, pte.frame, !pte.cow);
+    paddr = pte.frame * pageSize + offset;
+    return true;
+}
+
+size_t VirtualMemory::allocFrame() {
+    if (!freeFrames.empty()) {
+        size_t f = freeFrames.back(); freeFrames.pop_back();
+        return f;
+    }
+    if (nextFrame < numFrames) return nextFrame++;
+    // evict LRU
+    size_t victim = 0; size_t minAccess = (size_t)-1;
+    for (size_t f = 0; f < nextFrame; ++f) {
+        if (frames[f].refs && frames[f].lastAccess < minAccess) {
+            minAccess = frames[f].lastAccess; victim = f;
+        }
+    }
+    evictFrame(victim);
+    return victim;
+}
+
+void VirtualMemory::mapFrame(int pid, size_t vpn, size_t frame, bool cow, bool shared) {
+    procs[pid].pt[vpn] = {frame, cow, shared};
+    frames[frame].refs++;
+    frames[frame].mappers.push_back({pid, vpn});
+}
+
+void VirtualMemory::unmapPage(int pid, size_t vpn) {
+    Process &p = procs[pid];
+    auto it = p.pt.find(vpn);
+    if (it == p.pt.end()) return;
+    Frame &fr = frames[it->second.frame];
+    auto &m = fr.mappers;
+    m.erase(std::remove(m.begin(), m.end(), std::make_pair(pid, vpn)), m.end());
+    if (--fr.refs == 0) freeFrames.push_back(it->second.frame);
+    p.pt.erase(it);
+    tlbInvalidate(p.asid, vpn);
+}
+
+void VirtualMemory::evictFrame(size_t frame) {
+    // a shared frame is dropped from every address space that maps it
+    Frame &fr = frames[frame];
+    for (auto &m : fr.mappers) {
+        Process &p = procs[m.first];
+        p.pt.erase(m.second);
+        tlbInvalidate(p.asid, m.second);
+    }
+    fr.mappers.clear();
+    fr.refs = 0;
+    evictions++;
+}
+
+bool VirtualMemory::breakCow(int pid, size_t vpn) {
+    Process &p = procs[pid];
+    size_t old = p.pt[vpn].frame;
+    if (frames[old].refs == 1) {
+        // last mapper keeps the frame, no copy needed
+        p.pt[vpn].cow = false;
+        return true;
+    }
+    frames[old].lastAccess = accessCounter; // keep the source out of the eviction scan
+    size_t f = allocFrame();
+    bool evicted = p.pt.find(vpn) == p.pt.end();
+    // if allocFrame had to evict the source itself (e.g. one physical frame)
+    // every mapper lost the page: nothing to copy, it is a plain fault
+    if (!evicted) unmapPage(pid, vpn);
+    mapFrame(pid, vpn, f, false, false);
+    if (!evicted) cowCopies++;
+    return !evicted;
+}
+
+int VirtualMemory::fork() {
+    auto pit = procs.find(current);
+    if (!isInitialized() || pit == procs.end()) return -1;
+    int child = nextPid++;
+    Process &c = procs[child];
+    c.asid = nextAsid++;
+    Process &parent = procs[current];
+    for (auto &e : parent.pt) {
+        if (!e.second.shared) e.second.cow = true;
+        mapFrame(child, e.first, e.second.frame, e.second.cow, e.second.shared);
+    }
+    // parent's cached translations of now-COW pages lose write permission;
+    // shared pages stay writable
+    for (auto &t : tlb) {
+        if (t.asid != parent.asid) continue;
+        auto it = parent.pt.find(t.vpn);
+        if (it != parent.pt.end() && it->second.cow) t.writable = false;
+    }
+    return child;
+}
+
+bool VirtualMemory::switchTo(int pid) {
+    if (procs.find(pid) == procs.end()) return false;
+    if (pid == current) return true;
+    current = pid;
+    contextSwitches++;
+    if (tlbMode == TlbMode::FLUSH) { tlb.clear(); tlbFlushes++; }
+    return true;
+}
+
+bool VirtualMemory::share(int srcPid, size_t srcVaddr, size_t dstVaddr) {
+    if (!isInitialized() || numFrames == 0) return false;
+    if (procs.find(srcPid) == procs.end() || procs.find(current) == procs.end()) return false;
+    size_t svpn = srcVaddr / pageSize, dvpn = dstVaddr / pageSize;
+    if (srcPid == current && svpn == dvpn) return false;
+    accessCounter++;
+    Process &src = procs[srcPid];
+    auto it = src.pt.find(svpn);
+    if (it == src.pt.end()) {
+        // fault the page in on behalf of the source
+        pageFaults++; src.faults++;
+        mapFrame(srcPid, svpn, allocFrame(), false, false);
+    } else if (it->second.cow) {
+        breakCow(srcPid, svpn);
+    }
+    PageTableEntry &spte = src.pt[svpn];
+    spte.shared = true;
+    size_t f = spte.frame;
+    frames[f].lastAccess = accessCounter;
+    unmapPage(current, dvpn);
+    mapFrame(current, dvpn, f, false, true);
+    return true;
+}
+
+bool VirtualMemory::exitProcess(int pid) {
+    auto pit = procs.find(pid);
+    if (pit == procs.end()) return false;
+    std::vector<size_t> vpns;
+    for (auto &e : pit->second.pt) vpns.push_back(e.first);
+    for (size_t vpn : vpns) unmapPage(pid, vpn);
+    int asid = pit->second.asid;
+    tlb.erase(std::remove_if(tlb.begin(), tlb.end(),
+                             [asid](const TlbEntry &t) { return t.asid == asid; }), tlb.end());
+    procs.erase(pit);
+    if (current == pid) current = -1;
+    return true;
+}
+
+int VirtualMemory::asidOf(int pid) const {
+    auto it = procs.find(pid);
+    return it == procs.end() ? -1 : it->second.asid;
+}
+
+void VirtualMemory::setTlb(size_t entries, TlbMode mode) {
+    tlbSize = entries; tlbMode = mode;
+    tlb.clear();
+}
+
+VirtualMemory::TlbEntry *VirtualMemory::tlbLookup(int asid, size_t vpn) {
+    for (auto &t : tlb) if (t.asid == asid && t.vpn == vpn) return &t;
+    return nullptr;
+}
+
+void VirtualMemory::tlbInsert(int asid, size_t vpn, size_t frame, bool writable) {
+    if (tlbSize == 0) return;
+    if (TlbEntry *e = tlbLookup(asid, vpn)) {
+        *e = {asid, vpn, frame, writable, accessCounter};
+        return;
+    }
+    if (tlb.size() >= tlbSize) {
+        size_t idx = 0;
+        for (size_t i = 1; i < tlb.size(); ++i) if (tlb[i].lastUse < tlb[idx].lastUse) idx = i;
+        tlb.erase(tlb.begin() + idx);
+    }
+    tlb.push_back({asid, vpn, frame, writable, accessCounter});
+}
+
+void VirtualMemory::tlbInvalidate(int asid, size_t vpn) {
+    for (size_t i = 0; i < tlb.size(); ++i) {
+        if (tlb[i].asid == asid && tlb[i].vpn == vpn) { tlb.erase(tlb.begin() + i); return; }
     }
 }
 
 void VirtualMemory::stats() {
     std::cout << "Page hits=" << pageHits << " faults=" << pageFaults << "\n";
+    if (procs.size() <= 1 && contextSwitches == 0) return;
+    // TLB hit costs 1 cycle, a miss adds a 20 cycle page walk
+    size_t cycles = tlbHits * 1 + tlbMisses * 21;
+    std::cout << "TLB mode=" << (tlbMode == TlbMode::ASID ? "asid" : "flush") << " entries=" << tlbSize
+              << " hits=" << tlbHits << " misses=" << tlbMisses << " flushes=" << tlbFlushes
+              << " context_switches=" << contextSwitches << " translation_cycles=" << cycles << "\n";
+    size_t rssTotal = 0;
+    for (auto &p : procs) rssTotal += p.second.pt.size();
+    size_t used = nextFrame - freeFrames.size();
+    std::cout << "Processes=" << procs.size() << " frames_used=" << used << "/" << numFrames
+              << " rss_total=" << rssTotal << " shared_savings=" << (rssTotal - used) * pageSize
+              << " bytes cow_faults=" << cowFaults << " cow_copies=" << cowCopies
+              << " evictions=" << evictions << "\n";
+}
+
+void VirtualMemory::ps() {
+    for (auto &p : procs) {
+        size_t shared = 0;
+        for (auto &e : p.second.pt) if (frames[e.second.frame].refs > 1) shared++;
+        std::cout << (p.first == current ? "* " : "  ") << "pid=" << p.first << " asid=" << p.second.asid
+                  << " rss=" << p.second.pt.size() << " shared=" << shared
+                  << " faults=" << p.second.faults << " cow_faults=" << p.second.cowFaults
+                  << " hits=" << p.second.hits << "\n";
+    }
 }
@@ -1,22 +1,75 @@
 #pragma once
 #include <cstddef>
+#include <map>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
-struct PageTableEntry { bool valid; size_t frame; size_t lastAccess; };
+// Only resident pages have an entry; recency for LRU is tracked per frame.
+struct PageTableEntry {
+    size_t frame;
+    bool cow;    // read-only until written, then copied (set by fork)
+    bool shared; // explicitly shared mapping, never copied
+};
+
+enum class TlbMode { FLUSH, ASID };
 
 class VirtualMemory {
 public:
     VirtualMemory();
     void init(size_t virt_size, size_t page_size, size_t phys_size);
-    size_t translate(size_t vaddr); // returns phys addr, 0 on failure
+    size_t translate(size_t vaddr, bool write = false); // returns phys addr, 0 on failure
+    bool translate(size_t vaddr, bool write, size_t &paddr); // false on failure, paddr may be 0
     bool isInitialized() const { return pageSize > 0; }
     void stats();
 
+    // processes / address spaces
+    int fork();                    // forks the current process, returns child pid (-1 on failure)
+    bool switchTo(int pid);        // context switch; flushes the TLB in FLUSH mode
+    bool share(int srcPid, size_t srcVaddr, size_t dstVaddr); // map src page into current process
+    bool exitProcess(int pid);
+    int currentPid() const { return current; }
+    bool hasProcess(int pid) const { return procs.count(pid) > 0; }
+    int asidOf(int pid) const;
+    void setTlb(size_t entries, TlbMode mode);
+    void ps();
+
 private:
+    struct Process {
+        int asid;
+        std::unordered_map<size_t, PageTableEntry> pt; // vpn -> pte
+        size_t faults{0}, hits{0}, cowFaults{0};
+    };
+    struct Frame {
+        size_t refs{0};
+        size_t lastAccess{0};
+        std::vector<std::pair<int, size_t>> mappers; // (pid, vpn)
+    };
+    struct TlbEntry { int asid; size_t vpn; size_t frame; bool writable; size_t lastUse; };
+
     size_t virtSize{0}, pageSize{0}, physSize{0};
     size_t numPages{0}, numFrames{0};
-    std::unordered_map<size_t, PageTableEntry> pt; // vpn -> pte
+    std::map<int, Process> procs; // pid -> address space
+    int current{0};
+    int nextPid{1}, nextAsid{1};
+    std::vector<Frame> frames;
+    std::vector<size_t> freeFrames;
     size_t pageFaults{0}, pageHits{0};
     size_t nextFrame{0};
     size_t accessCounter{0};
+    size_t evictions{0}, cowFaults{0}, cowCopies{0};
+
+    std::vector<TlbEntry> tlb;
+    size_t tlbSize{16};
+    TlbMode tlbMode{TlbMode::ASID};
+    size_t tlbHits{0}, tlbMisses{0}, tlbFlushes{0}, contextSwitches{0};
+
+    size_t allocFrame();
+    void mapFrame(int pid, size_t vpn, size_t frame, bool cow, bool shared);
+    void unmapPage(int pid, size_t vpn);
+    void evictFrame(size_t frame);
+    bool breakCow(int pid, size_t vpn); // false if the source was evicted instead
+    TlbEntry *tlbLookup(int asid, size_t vpn);
+    void tlbInsert(int asid, size_t vpn, size_t frame, bool writable);
+    void tlbInvalidate(int asid, size_t vpn);
 };